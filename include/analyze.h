@@ -0,0 +1,56 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Static ROM analyzer
+// Disassembles a ROM from 0x200 before it is loaded, following jumps, calls and skips
+// to find the reachable code, its basic blocks and everything that is only data
+
+#define ROM_START 0x200
+#define ROM_END 0x1000
+// Code pages are 256 bytes, so the 4KB user address space fits in a 16 bit mask
+#define ROM_PAGE_SHIFT 8
+
+// Per address flags in ROM_ANALYSIS.map
+#define ROM_CODE        0x01 // An instruction starts here
+#define ROM_CODE_TAIL   0x02 // Second byte of an instruction
+#define ROM_BLOCK_START 0x04 // First instruction of a basic block (CFG export only, the interpreter ignores it)
+#define ROM_UNKNOWN     0x08 // Instruction chip8_cycle has no handler for
+#define ROM_SPRITE      0x10 // Read by DXYN
+#define ROM_WRITTEN     0x20 // Written by FX33 / FX55
+
+#define ROM_MAX_UNKNOWN 32
+
+typedef struct {
+    uint8_t map[ROM_END];
+    uint16_t size;
+
+    uint16_t instruction_count;
+    uint16_t block_count;
+    // Counted inside the ROM image only (sprites read from the fonts or scratch RAM don't count)
+    uint16_t code_bytes;
+    uint16_t sprite_bytes;
+
+    // Addresses of the first ROM_MAX_UNKNOWN unknown opcodes, unknown_count keeps counting past that
+    uint16_t unknown[ROM_MAX_UNKNOWN];
+    uint16_t unknown_count;
+
+    // Bit n set = page n of the ROM image may hold code that a store rewrites. Covers every code page
+    // when a store goes through an unknown I, and every page of the image once code is rewritten
+    // (the new instructions were never analyzed) or a BNNN is found (its targets are unknown)
+    uint16_t writable_code_pages;
+    // A store with a known I hits code
+    bool code_written;
+    // BNNN found -- its targets are unknown, so some code may be classed as data
+    bool indirect_jump;
+    // FX33 / FX55 with an I that could not be worked out
+    bool unknown_write;
+} ROM_ANALYSIS;
+
+void chip8_analyze_rom(ROM_ANALYSIS *analysis, const uint8_t *rom, size_t size);
+void chip8_analyze_write_dot(const ROM_ANALYSIS *analysis, const uint8_t *rom, FILE *f);
+
+#endif
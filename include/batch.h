@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "types.h"
+
+// Batched lockstep engine
+// Runs up to 32 instances of the same ROM side by side. V, I, pc, the timers and the CXNN random
+// state are stored structure-of-arrays (one vector per register, one lane per instance) so an instruction
+// all lanes agree on runs once for every lane. Lanes that diverge fall back to chip8_cycle.
+// The vectors use GCC vector extensions: SSE2 by default, AVX2 with -mavx2
+
+#define BATCH_MAX_LANES 32
+
+typedef uint8_t BATCH_U8 __attribute__((vector_size(BATCH_MAX_LANES)));
+typedef uint16_t BATCH_U16 __attribute__((vector_size(BATCH_MAX_LANES * 2)));
+typedef uint32_t BATCH_U32 __attribute__((vector_size(BATCH_MAX_LANES * 4)));
+
+typedef struct {
+    int lanes;
+
+    // True while every lane sits at the same pc. The SoA registers below are current then;
+    // once lanes split, each lane runs on its own CPU / IO until they line up again
+    bool converged;
+
+    // SoA state -- V[x][n] is register x of lane n
+    BATCH_U8 V[16];
+    BATCH_U16 I;
+    BATCH_U16 pc;
+    BATCH_U8 delay_timer;
+    BATCH_U8 sound_timer;
+    BATCH_U32 rng;
+
+    // Bursts to wait before trying to line diverged lanes up again (grows while attempts fail)
+    uint32_t catchup_wait;
+    uint32_t catchup_backoff;
+
+    // Instructions executed per lane
+    uint32_t executed[BATCH_MAX_LANES];
+
+    // Per lane memory, stack, display and keys. Callers may set each lane's keys (and seed it with
+    // chip8_batch_seed), but must not change the ROM image in one lane's memory only: on pages
+    // rom_info says no store reaches, lane 0's opcode is run for every lane without looking at the others
+    CPU *cpu;
+    IO *io;
+
+    // Used to tell when lanes may have rewritten their code and stopped sharing opcodes
+    ROM_ANALYSIS rom_info;
+
+    // Instructions run once for every lane together / run on a single lane
+    uint64_t vector_steps;
+    uint64_t scalar_steps;
+} CHIP8_BATCH;
+
+CHIP8_BATCH *chip8_batch_create(int lanes, const uint8_t *rom, size_t size);
+void chip8_batch_destroy(CHIP8_BATCH *batch);
+void chip8_batch_run(CHIP8_BATCH *batch, uint32_t instructions);
+void chip8_batch_tick_timers(CHIP8_BATCH *batch);
+void chip8_batch_sync(CHIP8_BATCH *batch);
+void chip8_batch_seed(CHIP8_BATCH *batch, int lane, uint32_t seed);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef OPCODE_H
+#define OPCODE_H
+
+#include <stdint.h>
+
+// Instruction decoding shared by the tracer, the ROM analyzer and the batch engine
+// Follows the switch in chip8_cycle (utils.c) quirks and all, so change the two together:
+//   EX.. other than EX9E / EXA1 falls through into the 0xF handlers and runs as FX..
+//   FX.. (and so EX..) with X == 0 is a kernel syscall, not a user instruction
+//   FX15 / FX18 do nothing, the timer cases are written as decimal 15 / 18 (FX0F / FX12)
+//   5XYN / 9XYN ignore N
+
+typedef enum {
+    OP_NONE,        // chip8_cycle has no handler for it and does nothing
+    OP_CLEAR,       // 00E0
+    OP_RETURN,      // 00EE
+    OP_JUMP,        // 1NNN
+    OP_CALL,        // 2NNN
+    OP_SKIP_EQ,     // 3XNN
+    OP_SKIP_NE,     // 4XNN
+    OP_SKIP_EQ_REG, // 5XYN
+    OP_SET,         // 6XNN
+    OP_ADD,         // 7XNN
+    OP_MOVE,        // 8XY0
+    OP_OR,          // 8XY1
+    OP_AND,         // 8XY2
+    OP_XOR,         // 8XY3
+    OP_ADD_REG,     // 8XY4
+    OP_SUB,         // 8XY5
+    OP_SHR,         // 8XY6
+    OP_SUBN,        // 8XY7
+    OP_SHL,         // 8XYE
+    OP_SKIP_NE_REG, // 9XYN
+    OP_SET_I,       // ANNN
+    OP_JUMP_V0,     // BNNN
+    OP_RANDOM,      // CXNN
+    OP_DRAW,        // DXYN
+    OP_SKIP_KEY,    // EX9E
+    OP_SKIP_NO_KEY, // EXA1
+    OP_GET_DELAY,   // FX07
+    OP_WAIT_KEY,    // FX0A
+    OP_SET_DELAY,   // FX0F
+    OP_SET_SOUND,   // FX12
+    OP_ADD_I,       // FX1E
+    OP_FONT,        // FX29
+    OP_BCD,         // FX33
+    OP_STORE,       // FX55
+    OP_LOAD,        // FX65
+    OP_SYSCALL      // F0NN / E0NN
+} OPCODE_CLASS;
+
+OPCODE_CLASS chip8_decode(uint16_t opcode);
+// Registers the instruction may write (bit n = V[n]) -- FX0A only writes VX once a key is down
+uint16_t chip8_registers_written(uint16_t opcode);
+// Bytes FX33 / FX55 write starting at I, 0 for everything else
+uint8_t chip8_memory_written(uint16_t opcode);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Execution trace recorder
+// chip8_cycle hands every executed instruction to the tracer attached to the current thread
+// Records are delta encoded into a byte stream and written to disk by a background thread
+//
+// File layout: "C8TR" + version byte, then one record per instruction:
+//   [flags] [pc delta] [opcode] [register values] [memory write]
+//   flags bit 0 (TRACE_F_PC)        - pc is not previous pc + 2, zigzag varint delta follows
+//   flags bit 1 (TRACE_F_OPCODE)    - opcode differs from the last one seen at this pc, 2 bytes follow
+//   flags bit 2 (TRACE_F_MEM)       - memory write: varint address, length byte, values
+//   flags bit 3 (TRACE_F_REG)       - the instruction writes exactly one register, index in bits 4-7, value byte follows
+//   flags bit 4 (TRACE_F_REG_MULTI) - only when bit 3 is clear: 2 byte register mask, then one value per set bit
+// Registers are recorded when the instruction writes them, even if the value is unchanged
+// (FX0A only writes VX once a key is down, the spins while it waits record no register)
+// A straight line instruction that writes one register costs 2 bytes
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+
+#define TRACE_F_PC        0x01
+#define TRACE_F_OPCODE    0x02
+#define TRACE_F_MEM       0x04
+#define TRACE_F_REG       0x08
+#define TRACE_F_REG_MULTI 0x10
+
+// Size of the pc indexed opcode cache (covers user and kernel memory)
+#define TRACE_PC_SLOTS 5120
+
+typedef struct {
+    uint16_t pc;
+    uint16_t opcode;
+
+    // Bit n set = V[n] written, V holds the value after execution
+    uint16_t reg_mask;
+    uint8_t V[16];
+
+    // Bytes written to memory by FX33 / FX55 (mem_len == 0 when nothing was written)
+    uint16_t mem_addr;
+    uint8_t mem_len;
+    uint8_t mem[16];
+} TRACE_RECORD;
+
+// Delta state shared by the encoder and decoder
+typedef struct {
+    uint16_t next_pc;
+    uint16_t opcodes[TRACE_PC_SLOTS];
+} TRACE_STATE;
+
+typedef struct TRACE TRACE;
+
+// Result of decoding one record
+typedef enum {
+    TRACE_READ_OK,
+    TRACE_READ_END,      // Clean end of file between records
+    TRACE_READ_TRUNCATED // File ends (or is corrupt) in the middle of a record
+} TRACE_READ_RESULT;
+
+// Tracer attached to the calling thread, NULL when tracing is off
+extern _Thread_local TRACE *chip8_active_trace;
+
+TRACE *chip8_trace_open(const char *path);
+void chip8_trace_close(TRACE *trace);
+void chip8_trace_step(TRACE *trace, uint16_t pc, uint16_t pc_after, uint16_t opcode, uint16_t I_before,
+                      const uint8_t V[16], const uint8_t *memory);
+uint64_t chip8_trace_count(const TRACE *trace);
+
+// Offline reading
+bool chip8_trace_read_header(FILE *f);
+TRACE_READ_RESULT chip8_trace_read(FILE *f, TRACE_STATE *state, TRACE_RECORD *record);
+
+#endif
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <SDL2/SDL.h>
+#include "trace.h"
+#include "analyze.h"
 
 typedef enum {
     KERNEL_MODE,
@@ -34,6 +36,9 @@ typedef struct {
 
     CPU_MODE mode;
 
+    // Random number state for CXNN (xorshift32, never 0) -- per instance so runs can be reproduced
+    uint32_t rng;
+
     // Example outline:
     // 6A02 -> 6 = instruction code -> A = register number -> [0][2] = immediate value -> V[A] = 02
     // I is used to hold a memory address until it is redefined
@@ -95,6 +100,7 @@ typedef struct {
 
 
 void chip8_init(CPU *cpu);
+void chip8_seed(CPU *cpu, uint32_t seed);
 void chip8_load_disk(CHIP8_SYSTEM *chip);
 void chip8_run_cli_prompt(CHIP8_SYSTEM *chip);
 void chip8_cycle(CPU *cpu, IO *io);
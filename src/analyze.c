@@ -0,0 +1,257 @@
+#include <string.h>
+#include "../include/analyze.h"
+#include "../include/opcode.h"
+
+// Value of I at an instruction, as far as the analyzer can tell
+#define I_UNVISITED -1
+#define I_VARIES -2
+
+// Anything chip8_cycle silently ignores counts as unknown, and so does a kernel syscall in user code
+static bool rom_opcode_known(uint16_t opcode) {
+    OPCODE_CLASS op = chip8_decode(opcode);
+    return op != OP_NONE && op != OP_SYSCALL;
+}
+
+// Fill next[] with the addresses that can run after the instruction at pc
+// *branch is set when the instruction ends a basic block
+static int rom_successors(uint16_t pc, uint16_t opcode, uint16_t next[2], bool *branch) {
+    *branch = true;
+    switch (chip8_decode(opcode)) {
+        case OP_RETURN:
+            return 0;
+        case OP_JUMP:
+            next[0] = opcode & 0x0FFF;
+            return 1;
+        // The subroutine, then the return site
+        case OP_CALL:
+            next[0] = opcode & 0x0FFF;
+            next[1] = pc + 2;
+            return 2;
+        case OP_SKIP_EQ:
+        case OP_SKIP_NE:
+        case OP_SKIP_EQ_REG:
+        case OP_SKIP_NE_REG:
+        case OP_SKIP_KEY:
+        case OP_SKIP_NO_KEY:
+            next[0] = pc + 2;
+            next[1] = pc + 4;
+            return 2;
+        // Jump + V0 -- target unknown
+        case OP_JUMP_V0:
+            return 0;
+        default:
+            break;
+    }
+    *branch = false;
+    next[0] = pc + 2;
+    return 1;
+}
+
+static bool rom_contains(const ROM_ANALYSIS *analysis, uint32_t addr) {
+    return addr >= ROM_START && addr + 1 < (uint32_t)ROM_START + analysis->size;
+}
+
+// Only addresses inside the ROM image are marked -- fonts and RAM past the ROM are not part of it
+static void rom_mark_range(ROM_ANALYSIS *analysis, int32_t start, int len, uint8_t flag) {
+    int32_t end = ROM_START + analysis->size;
+    for (int32_t addr = start < ROM_START ? ROM_START : start; addr < start + len && addr < end; addr++) {
+        analysis->map[addr] |= flag;
+    }
+}
+
+// rom holds the ROM image that will be copied to 0x200
+void chip8_analyze_rom(ROM_ANALYSIS *analysis, const uint8_t *rom, size_t size) {
+    memset(analysis, 0, sizeof(*analysis));
+    if (size > ROM_END - ROM_START) {
+        size = ROM_END - ROM_START;
+    }
+    analysis->size = size;
+
+    int32_t I_in[ROM_END];
+    bool queued[ROM_END];
+    uint16_t worklist[ROM_END];
+    int pending = 0;
+    for (int i = 0; i < ROM_END; i++) {
+        I_in[i] = I_UNVISITED;
+        queued[i] = false;
+    }
+
+    if (rom_contains(analysis, ROM_START)) {
+        I_in[ROM_START] = 0;
+        queued[ROM_START] = true;
+        worklist[pending++] = ROM_START;
+    }
+
+    // Walk every reachable instruction, tracking I so stores and draws can be attributed
+    // I only moves from unvisited -> known value -> varies, so this always settles
+    while (pending > 0) {
+        uint16_t pc = worklist[--pending];
+        queued[pc] = false;
+
+        uint16_t opcode = (rom[pc - ROM_START] << 8) | rom[pc + 1 - ROM_START];
+        OPCODE_CLASS op = chip8_decode(opcode);
+        int32_t I = I_in[pc];
+
+        analysis->map[pc] |= ROM_CODE;
+        analysis->map[pc + 1] |= ROM_CODE_TAIL;
+
+        switch (op) {
+            case OP_SET_I:
+                I = opcode & 0x0FFF;
+                break;
+            case OP_DRAW:
+                if (I >= 0) {
+                    rom_mark_range(analysis, I, opcode & 0x000F, ROM_SPRITE);
+                }
+                break;
+            // The bootloader syscall resets I as well
+            case OP_ADD_I:
+            case OP_FONT:
+            case OP_SYSCALL:
+                I = I_VARIES;
+                break;
+            case OP_BCD:
+            case OP_STORE:
+                if (I >= 0) {
+                    rom_mark_range(analysis, I, chip8_memory_written(opcode), ROM_WRITTEN);
+                } else {
+                    analysis->unknown_write = true;
+                }
+                break;
+            case OP_JUMP_V0:
+                analysis->indirect_jump = true;
+                break;
+            default:
+                break;
+        }
+
+        uint16_t next[2];
+        bool branch;
+        int count = rom_successors(pc, opcode, next, &branch);
+        for (int i = 0; i < count; i++) {
+            if (!rom_contains(analysis, next[i])) {
+                continue;
+            }
+            // The subroutine may change I before it returns
+            int32_t incoming = (op == OP_CALL && i == 1) ? I_VARIES : I;
+            int32_t old = I_in[next[i]];
+            int32_t merged = (old == I_UNVISITED || old == incoming) ? incoming : I_VARIES;
+            if (merged != old) {
+                I_in[next[i]] = merged;
+                if (!queued[next[i]]) {
+                    queued[next[i]] = true;
+                    worklist[pending++] = next[i];
+                }
+            }
+        }
+    }
+
+    // Block boundaries: the entry point and every target of a branch
+    if (analysis->map[ROM_START] & ROM_CODE) {
+        analysis->map[ROM_START] |= ROM_BLOCK_START;
+    }
+    for (int pc = ROM_START; pc < ROM_END; pc++) {
+        if (!(analysis->map[pc] & ROM_CODE)) {
+            continue;
+        }
+        uint16_t opcode = (rom[pc - ROM_START] << 8) | rom[pc + 1 - ROM_START];
+        uint16_t next[2];
+        bool branch;
+        int count = rom_successors(pc, opcode, next, &branch);
+        for (int i = 0; branch && i < count; i++) {
+            if (next[i] < ROM_END && (analysis->map[next[i]] & ROM_CODE)) {
+                analysis->map[next[i]] |= ROM_BLOCK_START;
+            }
+        }
+
+        analysis->instruction_count++;
+        if (!rom_opcode_known(opcode)) {
+            analysis->map[pc] |= ROM_UNKNOWN;
+            if (analysis->unknown_count < ROM_MAX_UNKNOWN) {
+                analysis->unknown[analysis->unknown_count] = pc;
+            }
+            analysis->unknown_count++;
+        }
+    }
+
+    for (int addr = ROM_START; addr < ROM_START + analysis->size; addr++) {
+        uint8_t flags = analysis->map[addr];
+        bool code = flags & (ROM_CODE | ROM_CODE_TAIL);
+        if (flags & ROM_BLOCK_START) {
+            analysis->block_count++;
+        }
+        if (code) {
+            analysis->code_bytes++;
+        } else if (flags & ROM_SPRITE) {
+            analysis->sprite_bytes++;
+        }
+        if (code && (flags & ROM_WRITTEN)) {
+            analysis->code_written = true;
+        }
+    }
+
+    // A store through an unknown I can hit any code page. Rewritten code (an ANNN pointed somewhere
+    // else, a jump into bytes never looked at) and code only reachable through BNNN were never
+    // analyzed, so any page of the image may hold code, and be written, in those cases
+    bool whole_image = analysis->code_written || analysis->indirect_jump;
+    for (int addr = ROM_START; addr < ROM_START + analysis->size; addr++) {
+        bool code = analysis->map[addr] & (ROM_CODE | ROM_CODE_TAIL);
+        if (whole_image || (code && analysis->unknown_write)) {
+            analysis->writable_code_pages |= 1 << (addr >> ROM_PAGE_SHIFT);
+        }
+    }
+}
+
+// Graphviz export: one node per basic block, edges for fall through, jumps, calls and skips
+void chip8_analyze_write_dot(const ROM_ANALYSIS *analysis, const uint8_t *rom, FILE *f) {
+    fprintf(f, "digraph rom {\n");
+    fprintf(f, "    node [shape=box fontname=monospace];\n");
+
+    for (int start = ROM_START; start < ROM_END; start++) {
+        if (!(analysis->map[start] & ROM_BLOCK_START)) {
+            continue;
+        }
+
+        // Block runs until a branch, the start of the next block or the end of the code
+        bool unknown = false;
+        int pc = start;
+        uint16_t opcode;
+        fprintf(f, "    b%03X [label=\"", start);
+        while (1) {
+            opcode = (rom[pc - ROM_START] << 8) | rom[pc + 1 - ROM_START];
+            unknown |= analysis->map[pc] & ROM_UNKNOWN;
+            fprintf(f, "0x%03X: %04X\\l", pc, opcode);
+
+            uint16_t next[2];
+            bool branch;
+            rom_successors(pc, opcode, next, &branch);
+            if (branch || pc + 2 >= ROM_END || !(analysis->map[pc + 2] & ROM_CODE) ||
+                (analysis->map[pc + 2] & ROM_BLOCK_START)) {
+                break;
+            }
+            pc += 2;
+        }
+        fprintf(f, "\"%s];\n", unknown ? " color=red" : "");
+
+        uint16_t next[2];
+        bool branch;
+        int count = rom_successors(pc, opcode, next, &branch);
+        for (int i = 0; i < count; i++) {
+            if (next[i] >= ROM_END || !(analysis->map[next[i]] & ROM_CODE)) {
+                continue;
+            }
+            const char *style = "";
+            if (chip8_decode(opcode) == OP_CALL) {
+                style = i == 0 ? " [label=call style=bold]" : " [style=dotted]";
+            } else if (branch && count == 2) {
+                style = i == 0 ? " [label=false]" : " [label=skip style=dashed]";
+            }
+            fprintf(f, "    b%03X -> b%03X%s;\n", start, next[i], style);
+        }
+        if (chip8_decode(opcode) == OP_JUMP_V0) {
+            fprintf(f, "    b%03X -> indirect_%03X [style=dashed];\n", start, pc);
+            fprintf(f, "    indirect_%03X [label=\"V0 + 0x%03X\" shape=ellipse];\n", pc, opcode & 0x0FFF);
+        }
+    }
+    fprintf(f, "}\n");
+}
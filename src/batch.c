@@ -0,0 +1,430 @@
+#include "../include/batch.h"
+#include "../include/opcode.h"
+
+// Instructions a diverged lane runs on its own before the batch tries to line the lanes up again
+#define BATCH_BURST 64
+// Single steps given to the lanes at the lowest pc when lining up (covers a lane skipped ahead)
+#define BATCH_CATCHUP 8
+// Most bursts skipped between attempts when lanes refuse to line up
+#define BATCH_MAX_BACKOFF 63
+
+// Signed views used to widen lane masks (0xFF -> 0xFFFF)
+typedef int8_t BATCH_S8 __attribute__((vector_size(BATCH_MAX_LANES)));
+typedef int16_t BATCH_S16 __attribute__((vector_size(BATCH_MAX_LANES * 2)));
+typedef int32_t BATCH_S32 __attribute__((vector_size(BATCH_MAX_LANES * 4)));
+
+// Keep lanes outside mask, take val inside it
+#define BATCH_BLEND(dst, val, mask) ((dst) = ((dst) & ~(mask)) | ((val) & (mask)))
+
+CHIP8_BATCH *chip8_batch_create(int lanes, const uint8_t *rom, size_t size) {
+    if (lanes < 1 || lanes > BATCH_MAX_LANES || size > ROM_END - ROM_START) {
+        printf("Batch needs 1 to %d lanes and a ROM under %d bytes\n", BATCH_MAX_LANES, ROM_END - ROM_START);
+        return NULL;
+    }
+
+    size_t bytes = (sizeof(CHIP8_BATCH) + _Alignof(CHIP8_BATCH) - 1) / _Alignof(CHIP8_BATCH) * _Alignof(CHIP8_BATCH);
+    CHIP8_BATCH *batch = aligned_alloc(_Alignof(CHIP8_BATCH), bytes);
+    if (batch == NULL) {
+        return NULL;
+    }
+    memset(batch, 0, sizeof(*batch));
+    batch->lanes = lanes;
+    batch->converged = true;
+    batch->cpu = calloc(lanes, sizeof(CPU));
+    batch->io = calloc(lanes, sizeof(IO));
+
+    // Set up lane 0 the normal way and clone it, the lanes only differ once the caller changes them
+    // (their keys -- never the ROM image, see batch.h)
+    chip8_init(&batch->cpu[0]);
+    memcpy(&batch->cpu[0].memory[ROM_START], rom, size);
+    batch->cpu[0].pc = ROM_START;
+    for (int lane = 1; lane < lanes; lane++) {
+        batch->cpu[lane] = batch->cpu[0];
+    }
+    for (int lane = 0; lane < lanes; lane++) {
+        batch->pc[lane] = ROM_START;
+        batch->rng[lane] = batch->cpu[lane].rng;
+    }
+
+    chip8_analyze_rom(&batch->rom_info, rom, size);
+    return batch;
+}
+
+void chip8_batch_destroy(CHIP8_BATCH *batch) {
+    if (batch == NULL) {
+        return;
+    }
+    free(batch->cpu);
+    free(batch->io);
+    free(batch);
+}
+
+// SoA registers -> one lane's CPU / IO
+static void batch_store_lane(CHIP8_BATCH *batch, int lane) {
+    for (int x = 0; x < 16; x++) {
+        batch->cpu[lane].V[x] = batch->V[x][lane];
+    }
+    batch->cpu[lane].I = batch->I[lane];
+    batch->cpu[lane].pc = batch->pc[lane];
+    batch->io[lane].delay_timer = batch->delay_timer[lane];
+    batch->io[lane].sound_timer = batch->sound_timer[lane];
+    batch->cpu[lane].rng = batch->rng[lane];
+}
+
+// One lane's CPU / IO -> SoA registers
+static void batch_load_lane(CHIP8_BATCH *batch, int lane) {
+    for (int x = 0; x < 16; x++) {
+        batch->V[x][lane] = batch->cpu[lane].V[x];
+    }
+    batch->I[lane] = batch->cpu[lane].I;
+    batch->pc[lane] = batch->cpu[lane].pc;
+    batch->delay_timer[lane] = batch->io[lane].delay_timer;
+    batch->sound_timer[lane] = batch->io[lane].sound_timer;
+    batch->rng[lane] = batch->cpu[lane].rng;
+}
+
+// Make every lane's CPU / IO current (they already are while diverged)
+void chip8_batch_sync(CHIP8_BATCH *batch) {
+    if (!batch->converged) {
+        return;
+    }
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        batch_store_lane(batch, lane);
+    }
+}
+
+// Give one lane its own CXNN sequence (chip8_seed for a lane)
+void chip8_batch_seed(CHIP8_BATCH *batch, int lane, uint32_t seed) {
+    chip8_seed(&batch->cpu[lane], seed);
+    batch->rng[lane] = batch->cpu[lane].rng;
+}
+
+static void batch_diverge(CHIP8_BATCH *batch) {
+    chip8_batch_sync(batch);
+    batch->converged = false;
+}
+
+// True when every lane in mask has the same value (all set or all clear)
+static bool batch_uniform(const BATCH_U8 *value, const BATCH_U8 *mask) {
+    uint64_t v[BATCH_MAX_LANES / 8], m[BATCH_MAX_LANES / 8];
+    memcpy(v, value, sizeof(v));
+    memcpy(m, mask, sizeof(m));
+    uint64_t any = 0, all = 0;
+    for (int i = 0; i < BATCH_MAX_LANES / 8; i++) {
+        any |= v[i] & m[i];
+        all |= (v[i] & m[i]) ^ m[i];
+    }
+    return any == 0 || all == 0;
+}
+
+// Skip instructions become a per lane mask -- the common case is every lane going the same way
+static bool batch_skip(CHIP8_BATCH *batch, const BATCH_U8 *skip, const BATCH_U8 *mask8, const BATCH_U16 *mask16,
+                       uint16_t *pc, bool *split) {
+    uint16_t next_pc = *pc + 2;
+    if (batch_uniform(skip, mask8)) {
+        *pc = (*skip)[0] ? next_pc + 2 : next_pc;
+        return true;
+    }
+    *split = true;
+    BATCH_U16 lanes_pc = (BATCH_U16){0} + next_pc + (__builtin_convertvector(*skip, BATCH_U16) & 2);
+    BATCH_BLEND(batch->pc, lanes_pc, *mask16);
+    return true;
+}
+
+// Run opcode on every lane in mask (always including lane 0) at once. While the lanes agree their shared pc is kept
+// in *pc; when they stop agreeing *split is set and each lane's pc is written to batch->pc
+// Returns false for anything that touches per lane memory, the stack, the display
+// or keys -- those go through chip8_cycle instead
+static bool batch_vector_step(CHIP8_BATCH *batch, uint16_t opcode, const BATCH_U8 *mask8, const BATCH_U16 *mask16,
+                              uint16_t *pc, bool *split) {
+    BATCH_U8 m = *mask8;
+    uint8_t register_num = (opcode >> 8) & 0x0F;
+    uint8_t y = (opcode >> 4) & 0x0F;
+    uint8_t immediate_value = opcode & 0x00FF;
+    BATCH_U8 *VX = &batch->V[register_num];
+    BATCH_U8 *VY = &batch->V[y];
+    BATCH_U8 *VF = &batch->V[0xF];
+
+    BATCH_U8 skip;
+    uint16_t next_pc = *pc + 2;
+
+    switch (chip8_decode(opcode)) {
+        case OP_JUMP:
+            *pc = opcode & 0x0FFF;
+            return true;
+        case OP_SKIP_EQ:
+            skip = (BATCH_U8)(*VX == immediate_value);
+            return batch_skip(batch, &skip, mask8, mask16, pc, split);
+        case OP_SKIP_NE:
+            skip = (BATCH_U8)(*VX != immediate_value);
+            return batch_skip(batch, &skip, mask8, mask16, pc, split);
+        case OP_SKIP_EQ_REG:
+            skip = (BATCH_U8)(*VX == *VY);
+            return batch_skip(batch, &skip, mask8, mask16, pc, split);
+        case OP_SKIP_NE_REG:
+            skip = (BATCH_U8)(*VX != *VY);
+            return batch_skip(batch, &skip, mask8, mask16, pc, split);
+        case OP_SET:
+            BATCH_BLEND(*VX, (BATCH_U8){0} + immediate_value, m);
+            break;
+        case OP_ADD:
+            BATCH_BLEND(*VX, *VX + immediate_value, m);
+            break;
+        // Same order of writes as chip8_cycle so X == F / Y == F behave the same
+        case OP_MOVE:
+            BATCH_BLEND(*VX, *VY, m);
+            break;
+        case OP_OR:
+            BATCH_BLEND(*VX, *VX | *VY, m);
+            break;
+        case OP_AND:
+            BATCH_BLEND(*VX, *VX & *VY, m);
+            break;
+        case OP_XOR:
+            BATCH_BLEND(*VX, *VX ^ *VY, m);
+            break;
+        case OP_ADD_REG: {
+            BATCH_U8 x = *VX;
+            BATCH_U8 sum = x + *VY;
+            BATCH_BLEND(*VX, sum, m);
+            BATCH_BLEND(*VF, (BATCH_U8)(sum < x) & 1, m);
+            break;
+        }
+        case OP_SUB: {
+            BATCH_U8 x = *VX;
+            BATCH_U8 vy = *VY;
+            BATCH_BLEND(*VF, (BATCH_U8)(x >= vy) & 1, m);
+            BATCH_BLEND(*VX, x - vy, m);
+            break;
+        }
+        case OP_SHR: {
+            BATCH_U8 x = *VX;
+            BATCH_BLEND(*VX, x >> 1, m);
+            BATCH_BLEND(*VF, x & 1, m);
+            break;
+        }
+        case OP_SUBN:
+            BATCH_BLEND(*VF, (BATCH_U8)(*VY >= *VX) & 1, m);
+            BATCH_BLEND(*VX, *VY - *VX, m);
+            break;
+        case OP_SHL: {
+            BATCH_U8 x = *VX;
+            BATCH_BLEND(*VX, x << 1, m);
+            BATCH_BLEND(*VF, x >> 7, m);
+            break;
+        }
+        case OP_SET_I:
+            BATCH_BLEND(batch->I, (BATCH_U16){0} + (opcode & 0x0FFF), *mask16);
+            break;
+        // Jump + V0 -- lanes only stay together when V0 matches everywhere
+        case OP_JUMP_V0: {
+            BATCH_U16 targets = __builtin_convertvector(batch->V[0], BATCH_U16) + (opcode & 0x0FFF);
+            BATCH_U8 other_v0 = (BATCH_U8)(batch->V[0] != batch->V[0][0]);
+            if (batch_uniform(&other_v0, mask8)) {
+                *pc = targets[0];
+            } else {
+                *split = true;
+                BATCH_BLEND(batch->pc, targets, *mask16);
+            }
+            return true;
+        }
+        // Same xorshift32 step as chip8_random, every lane on its own state
+        case OP_RANDOM: {
+            BATCH_U32 x = batch->rng;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            BATCH_BLEND(batch->rng, x, (BATCH_U32)__builtin_convertvector((BATCH_S8)m, BATCH_S32));
+            BATCH_BLEND(*VX, __builtin_convertvector(x >> 24, BATCH_U8) & immediate_value, m);
+            break;
+        }
+        case OP_GET_DELAY:
+            BATCH_BLEND(*VX, batch->delay_timer, m);
+            break;
+        case OP_ADD_I:
+            BATCH_BLEND(batch->I, batch->I + __builtin_convertvector(*VX, BATCH_U16), *mask16);
+            break;
+        default:
+            return false;
+    }
+    *pc = next_pc;
+    return true;
+}
+
+// True when every lane is guaranteed to hold the same opcode at pc: inside the ROM image and both bytes on
+// pages no store can reach (an instruction at the end of a page takes its second byte from the next one)
+static bool batch_shared_code(const CHIP8_BATCH *batch, uint16_t pc) {
+    if (pc < ROM_START || pc + 1 >= ROM_START + batch->rom_info.size) {
+        return false;
+    }
+    uint16_t pages = (1 << (pc >> ROM_PAGE_SHIFT)) | (1 << ((pc + 1) >> ROM_PAGE_SHIFT));
+    return !(batch->rom_info.writable_code_pages & pages);
+}
+
+// All lanes share a pc: run `budget` instructions on them together
+static void batch_run_converged(CHIP8_BATCH *batch, uint32_t budget) {
+    BATCH_U8 mask8 = {0};
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        mask8[lane] = 0xFF;
+    }
+    BATCH_U16 mask16 = (BATCH_U16)__builtin_convertvector((BATCH_S8)mask8, BATCH_S16);
+    uint16_t pc = batch->pc[0];
+    uint32_t steps = 0;
+    bool split = false;
+
+    while (steps < budget) {
+        if (pc + 1 >= (int)sizeof(batch->cpu[0].memory)) {
+            break;
+        }
+
+        uint16_t opcode = (batch->cpu[0].memory[pc] << 8) | batch->cpu[0].memory[pc + 1];
+        if (!batch_shared_code(batch, pc)) {
+            bool same = true;
+            for (int lane = 1; lane < batch->lanes; lane++) {
+                if (((batch->cpu[lane].memory[pc] << 8) | batch->cpu[lane].memory[pc + 1]) != opcode) {
+                    same = false;
+                }
+            }
+            if (!same) {
+                break;
+            }
+        }
+
+        if (batch_vector_step(batch, opcode, &mask8, &mask16, &pc, &split)) {
+            steps++;
+            batch->vector_steps++;
+            if (split) {
+                break;
+            }
+            continue;
+        }
+
+        // Everyone runs the same instruction through chip8_cycle, then check they still agree
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            batch->pc[lane] = pc;
+            batch_store_lane(batch, lane);
+            chip8_cycle(&batch->cpu[lane], &batch->io[lane]);
+            batch_load_lane(batch, lane);
+            batch->scalar_steps++;
+        }
+        steps++;
+        pc = batch->pc[0];
+        BATCH_U8 moved = (BATCH_U8)__builtin_convertvector((BATCH_S16)(batch->pc != pc), BATCH_S8);
+        if (!batch_uniform(&moved, &mask8)) {
+            split = true;
+            break;
+        }
+    }
+
+    if (!split) {
+        BATCH_BLEND(batch->pc, (BATCH_U16){0} + pc, mask16);
+    }
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        batch->executed[lane] += steps;
+    }
+    // Stopped early or split on the last step: lanes no longer agree on pc or opcode
+    if (split || steps < budget) {
+        batch_diverge(batch);
+    }
+}
+
+// Lanes disagree: run each one on its own for a while, then try to line them back up
+static void batch_run_diverged(CHIP8_BATCH *batch, const uint32_t *target) {
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        uint32_t left = target[lane] - batch->executed[lane];
+        uint32_t burst = left < BATCH_BURST ? left : BATCH_BURST;
+        for (uint32_t i = 0; i < burst; i++) {
+            chip8_cycle(&batch->cpu[lane], &batch->io[lane]);
+        }
+        batch->executed[lane] += burst;
+        batch->scalar_steps += burst;
+    }
+
+    // Lanes that keep failing to line up are probably running different code, so try less often
+    if (batch->catchup_wait > 0) {
+        batch->catchup_wait--;
+        return;
+    }
+
+    // A skip leaves lanes one instruction apart in the same code, stepping whoever is
+    // at the lowest pc usually brings them back together
+    for (int round = 0; round < BATCH_CATCHUP; round++) {
+        uint16_t low = 0xFFFF, high = 0;
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            uint16_t pc = batch->cpu[lane].pc;
+            low = pc < low ? pc : low;
+            high = pc > high ? pc : high;
+        }
+        if (low == high) {
+            for (int lane = 0; lane < batch->lanes; lane++) {
+                batch_load_lane(batch, lane);
+            }
+            batch->converged = true;
+            batch->catchup_backoff = 0;
+            return;
+        }
+        bool stepped = false;
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            if (batch->executed[lane] < target[lane] && batch->cpu[lane].pc == low) {
+                chip8_cycle(&batch->cpu[lane], &batch->io[lane]);
+                batch->executed[lane]++;
+                batch->scalar_steps++;
+                stepped = true;
+            }
+        }
+        // The lane at the lowest pc is out of work for this run
+        if (!stepped) {
+            break;
+        }
+    }
+
+    if (batch->catchup_backoff < BATCH_MAX_BACKOFF) {
+        batch->catchup_backoff = batch->catchup_backoff * 2 + 1;
+    }
+    batch->catchup_wait = batch->catchup_backoff;
+}
+
+// Run every lane until it has executed `instructions` more instructions
+void chip8_batch_run(CHIP8_BATCH *batch, uint32_t instructions) {
+    uint32_t target[BATCH_MAX_LANES];
+    for (int lane = 0; lane < batch->lanes; lane++) {
+        target[lane] = batch->executed[lane] + instructions;
+    }
+
+    while (1) {
+        // Lanes with work left, and the smallest amount of work among them
+        int active = 0;
+        uint32_t budget = UINT32_MAX;
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            uint32_t left = target[lane] - batch->executed[lane];
+            if (left > 0) {
+                budget = left < budget ? left : budget;
+                active++;
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+
+        // Lanes that ran out of work would stay behind, so the rest can't keep a shared pc
+        if (batch->converged && active < batch->lanes) {
+            batch_diverge(batch);
+        }
+        if (batch->converged) {
+            batch_run_converged(batch, budget);
+        } else {
+            batch_run_diverged(batch, target);
+        }
+    }
+}
+
+void chip8_batch_tick_timers(CHIP8_BATCH *batch) {
+    if (!batch->converged) {
+        for (int lane = 0; lane < batch->lanes; lane++) {
+            chip8_tick_timers(&batch->io[lane]);
+        }
+        return;
+    }
+    batch->delay_timer -= (BATCH_U8)(batch->delay_timer != 0) & 1;
+    batch->sound_timer -= (BATCH_U8)(batch->sound_timer != 0) & 1;
+}
@@ -16,6 +16,13 @@ int main () {
     }
 
     chip8_run_cli_prompt(&chip);
+
+    // Optional execution trace: CHIP_OS_TRACE=run.trace ./chip_os
+    TRACE *trace = NULL;
+    if (getenv("CHIP_OS_TRACE") != NULL) {
+        trace = chip8_trace_open(getenv("CHIP_OS_TRACE"));
+        chip8_active_trace = trace;
+    }
         
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -36,6 +43,12 @@ int main () {
 
     chip8_handle_rom(&chip, renderer);
 
+    if (trace != NULL) {
+        printf("Traced %lu instructions\n", (unsigned long)chip8_trace_count(trace));
+        chip8_active_trace = NULL;
+        chip8_trace_close(trace);
+    }
+
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
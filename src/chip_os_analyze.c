@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/analyze.h"
+
+// Batch front end for the static ROM analyzer
+// chip_os_analyze <rom.ch8>...            -- one summary line per ROM, bucketed by compatibility
+// chip_os_analyze -d out.dot <rom.ch8>    -- also write the control-flow graph as Graphviz
+
+// Buckets, worst first:
+//   unknown  - reaches opcodes chip8_cycle has no handler for
+//   selfmod  - stores into its own code pages
+//   partial  - BNNN or stores through an unknown I, so the analysis may be incomplete
+//   ok       - everything reachable is understood
+static const char *rom_bucket(const ROM_ANALYSIS *analysis) {
+    if (analysis->unknown_count > 0) {
+        return "unknown";
+    }
+    if (analysis->code_written) {
+        return "selfmod";
+    }
+    if (analysis->indirect_jump || analysis->unknown_write) {
+        return "partial";
+    }
+    return "ok";
+}
+
+int main(int argc, char **argv) {
+    const char *dot_path = NULL;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-d") == 0) {
+        dot_path = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        printf("Usage: %s [-d out.dot] <rom.ch8>...\n", argv[0]);
+        return 2;
+    }
+
+    static ROM_ANALYSIS analysis;
+    uint8_t rom[ROM_END - ROM_START];
+    int failed = 0;
+
+    printf("%-8s %6s %6s %6s %6s %7s  %s\n", "bucket", "size", "code", "sprite", "blocks", "unknown", "rom");
+    for (int i = first; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (f == NULL) {
+            printf("Failed to open %s\n", argv[i]);
+            failed = 1;
+            continue;
+        }
+        size_t size = fread(rom, 1, sizeof(rom), f);
+        fclose(f);
+
+        chip8_analyze_rom(&analysis, rom, size);
+        printf("%-8s %6u %6u %6u %6u %7u  %s\n", rom_bucket(&analysis), analysis.size, analysis.code_bytes,
+               analysis.sprite_bytes, analysis.block_count, analysis.unknown_count, argv[i]);
+
+        if (dot_path != NULL) {
+            FILE *dot = fopen(dot_path, "w");
+            if (dot == NULL) {
+                printf("Failed to open %s\n", dot_path);
+                return 2;
+            }
+            chip8_analyze_write_dot(&analysis, rom, dot);
+            fclose(dot);
+            // Only the first ROM gets a graph
+            dot_path = NULL;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,227 @@
+#include <time.h>
+#include "../include/batch.h"
+
+// Throughput benchmark and correctness check for the batched engine
+// chip_os_batch <rom.ch8> [lanes] [instructions per lane]
+//   Runs the same instances twice: one chip8_cycle loop per instance (baseline), then as one batch.
+// chip_os_batch -v [rom.ch8...]
+//   Runs built in ROMs that caught batch bugs, then each ROM given, both ways with several lane counts and
+//   instructions per call, and compares every lane's registers, stack, memory, display and timers.
+// Lane n holds key n % 16 down and is seeded with n + 1 so the instances see different input
+
+// Instructions per chip8_batch_run call tried by -v: single steps, chip8_handle_rom's 9 per frame,
+// and values that end runs at different points of the ROM
+static const uint32_t verify_per_call[] = {1, 9, 10, 64};
+static const int verify_lanes[] = {1, 8, 32};
+
+// Lanes split on E59E, the 9th instruction: lanes holding key 5 skip to 0x214 and count up V1,
+// the others spin on 0x212. Catches a split on the last instruction of a run
+static const uint8_t split_rom[] = {
+    0x60, 0x00, 0x61, 0x01, 0x62, 0x02, 0x63, 0x03, 0x64, 0x04, 0x65, 0x05, 0x66, 0x06, 0x67, 0x07,
+    0xE5, 0x9E, 0x12, 0x12, 0x71, 0x01, 0x12, 0x14
+};
+
+// Rewrites the A280 at 0x20C to A310, so the F155 after it stores 63 <key> over the code at 0x310
+// instead of 0x280. Catches rewritten code being treated as shared
+static const uint8_t selfmod_rom[0x114] = {
+    0x60, 0xA3, 0x61, 0x10, 0xA2, 0x0C, 0xF1, 0x55, 0xF1, 0x0A, 0x60, 0x63, 0xA2, 0x80, 0xF1, 0x55,
+    0x63, 0x00, 0x13, 0x10,
+    [0x110] = 0x63, 0x00, 0x13, 0x12
+};
+
+// Stores <key> <key> at 0x300, then runs the 63 00 at 0x2FF, which reads its second byte from page 3,
+// and the 0K00 no-op after it before parking on 0x303
+static const uint8_t straddle_rom[0x105] = {
+    0xF1, 0x0A, 0x80, 0x10, 0xA3, 0x00, 0xF1, 0x55, 0x12, 0xFF,
+    [0xFF] = 0x63, 0x00, 0x00, 0x00, 0x13, 0x03
+};
+
+// Lanes draw their own CXNN values and split on them. Both paths are 2 instructions long and meet at
+// 0x210, so lanes line up again and the next CXNN runs vectorized from per lane state
+static const uint8_t random_rom[] = {
+    0xC0, 0xFF, 0xC1, 0x07, 0x80, 0x12, 0x30, 0x00, 0x12, 0x0E, 0xC2, 0xFF, 0x12, 0x10, 0xC3, 0xFF,
+    0x74, 0x01, 0x12, 0x00
+};
+
+static const struct {
+    const char *name;
+    const uint8_t *rom;
+    size_t size;
+} builtin_roms[] = {
+    {"split", split_rom, sizeof(split_rom)},
+    {"selfmod", selfmod_rom, sizeof(selfmod_rom)},
+    {"straddle", straddle_rom, sizeof(straddle_rom)},
+    {"random", random_rom, sizeof(random_rom)}
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Baseline: independent instances stepped with chip8_cycle
+static void run_scalar(CPU *cpu, IO *io, int lanes, long frames, uint32_t per_call) {
+    for (long frame = 0; frame < frames; frame++) {
+        for (int lane = 0; lane < lanes; lane++) {
+            for (uint32_t i = 0; i < per_call; i++) {
+                chip8_cycle(&cpu[lane], &io[lane]);
+            }
+            chip8_tick_timers(&io[lane]);
+        }
+    }
+}
+
+static void run_batch(CHIP8_BATCH *batch, long frames, uint32_t per_call) {
+    for (long frame = 0; frame < frames; frame++) {
+        chip8_batch_run(batch, per_call);
+        chip8_batch_tick_timers(batch);
+    }
+}
+
+// Name of the first thing that differs between a batch lane and its baseline instance, NULL if none
+static const char *lane_difference(const CPU *a, const IO *a_io, const CPU *b, const IO *b_io) {
+    if (a->pc != b->pc) return "pc";
+    if (memcmp(a->V, b->V, sizeof(a->V)) != 0) return "V";
+    if (a->I != b->I) return "I";
+    if (a->sp != b->sp || memcmp(a->stack, b->stack, sizeof(a->stack)) != 0) return "stack";
+    if (memcmp(a->memory, b->memory, sizeof(a->memory)) != 0) return "memory";
+    if (memcmp(a_io->display, b_io->display, sizeof(a_io->display)) != 0) return "display";
+    if (a_io->delay_timer != b_io->delay_timer || a_io->sound_timer != b_io->sound_timer) return "timers";
+    return NULL;
+}
+
+// Returns the number of lanes that ended up different from their baseline instance
+static int verify_rom(const char *name, const uint8_t *rom, size_t size, int lanes, uint32_t per_call) {
+    // Same instructions per lane for every per_call value (a multiple of 1, 9, 10 and 64)
+    long frames = 5760 / per_call;
+
+    CHIP8_BATCH *batch = chip8_batch_create(lanes, rom, size);
+    if (batch == NULL) {
+        return lanes;
+    }
+    for (int lane = 0; lane < lanes; lane++) {
+        batch->io[lane].keys[lane % 16] = true;
+        chip8_batch_seed(batch, lane, lane + 1);
+    }
+    CPU *cpu = malloc(sizeof(CPU) * lanes);
+    IO *io = malloc(sizeof(IO) * lanes);
+    memcpy(cpu, batch->cpu, sizeof(CPU) * lanes);
+    memcpy(io, batch->io, sizeof(IO) * lanes);
+
+    run_scalar(cpu, io, lanes, frames, per_call);
+    run_batch(batch, frames, per_call);
+    chip8_batch_sync(batch);
+
+    int failed = 0;
+    for (int lane = 0; lane < lanes; lane++) {
+        const char *field = lane_difference(&batch->cpu[lane], &batch->io[lane], &cpu[lane], &io[lane]);
+        if (field != NULL) {
+            if (failed == 0) {
+                printf("%s: %d lanes, %u per call: lane %d %s differs (pc 0x%03X, expected 0x%03X)\n", name, lanes,
+                       per_call, lane, field, batch->cpu[lane].pc, cpu[lane].pc);
+            }
+            failed++;
+        }
+    }
+    if (failed > 0) {
+        printf("%s: %d lanes, %u per call: %d lanes differ\n", name, lanes, per_call, failed);
+    }
+
+    free(cpu);
+    free(io);
+    chip8_batch_destroy(batch);
+    return failed;
+}
+
+static int verify(int count, char **paths) {
+    int failed = 0;
+    int checks = 0;
+    int builtin = sizeof(builtin_roms) / sizeof(builtin_roms[0]);
+    for (int i = -builtin; i < count; i++) {
+        uint8_t rom[ROM_END - ROM_START];
+        const char *name;
+        size_t size;
+        if (i < 0) {
+            name = builtin_roms[i + builtin].name;
+            size = builtin_roms[i + builtin].size;
+            memcpy(rom, builtin_roms[i + builtin].rom, size);
+        } else {
+            FILE *f = fopen(paths[i], "rb");
+            if (f == NULL) {
+                printf("Failed to open %s\n", paths[i]);
+                failed++;
+                continue;
+            }
+            name = paths[i];
+            size = fread(rom, 1, sizeof(rom), f);
+            fclose(f);
+        }
+
+        for (size_t l = 0; l < sizeof(verify_lanes) / sizeof(verify_lanes[0]); l++) {
+            for (size_t p = 0; p < sizeof(verify_per_call) / sizeof(verify_per_call[0]); p++) {
+                failed += verify_rom(name, rom, size, verify_lanes[l], verify_per_call[p]) > 0;
+                checks++;
+            }
+        }
+    }
+    printf("%d of %d checks match the chip8_cycle baseline\n", checks - failed, checks);
+    return failed > 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "-v") == 0) {
+        return verify(argc - 2, argv + 2);
+    }
+    if (argc < 2) {
+        printf("Usage: %s <rom.ch8> [lanes] [instructions per lane]\n"
+               "       %s -v [rom.ch8...]\n", argv[0], argv[0]);
+        return 2;
+    }
+    int lanes = argc > 2 ? atoi(argv[2]) : BATCH_MAX_LANES;
+    long instructions = argc > 3 ? atol(argv[3]) : 1000000;
+    // CHIP-8 runs ~9 instructions per 60Hz timer tick, same as chip8_handle_rom
+    long frames = instructions / 9;
+
+    uint8_t rom[ROM_END - ROM_START];
+    FILE *f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        printf("Failed to open %s\n", argv[1]);
+        return 2;
+    }
+    size_t size = fread(rom, 1, sizeof(rom), f);
+    fclose(f);
+
+    CHIP8_BATCH *batch = chip8_batch_create(lanes, rom, size);
+    if (batch == NULL) {
+        return 2;
+    }
+    for (int lane = 0; lane < lanes; lane++) {
+        batch->io[lane].keys[lane % 16] = true;
+        chip8_batch_seed(batch, lane, lane + 1);
+    }
+
+    CPU *cpu = malloc(sizeof(CPU) * lanes);
+    IO *io = malloc(sizeof(IO) * lanes);
+    memcpy(cpu, batch->cpu, sizeof(CPU) * lanes);
+    memcpy(io, batch->io, sizeof(IO) * lanes);
+
+    double start = now_seconds();
+    run_scalar(cpu, io, lanes, frames, 9);
+    double scalar_time = now_seconds() - start;
+
+    start = now_seconds();
+    run_batch(batch, frames, 9);
+    double batch_time = now_seconds() - start;
+
+    double total = (double)frames * 9 * lanes;
+    printf("%d lanes, %ld instructions per lane\n", lanes, frames * 9);
+    printf("scalar: %8.1f M instance-instructions/s\n", total / scalar_time / 1e6);
+    printf("batch:  %8.1f M instance-instructions/s (%.2fx)\n", total / batch_time / 1e6, scalar_time / batch_time);
+    printf("vectorized: %.1f%% of instance-instructions\n", 100.0 * batch->vector_steps * lanes / total);
+
+    free(cpu);
+    free(io);
+    chip8_batch_destroy(batch);
+    return 0;
+}
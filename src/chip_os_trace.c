@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/trace.h"
+
+// Offline analyzer for traces recorded with CHIP_OS_TRACE
+// chip_os_trace diff <a.trace> <b.trace> -- report the first instruction where two runs diverge
+// chip_os_trace hist <a.trace>           -- opcode histogram
+
+static FILE *open_trace(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("Failed to open %s\n", path);
+        return NULL;
+    }
+    if (!chip8_trace_read_header(f)) {
+        printf("%s is not a CHIP_OS trace\n", path);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void print_record(const char *label, const TRACE_RECORD *r) {
+    printf("  %s: pc=0x%03X opcode=0x%04X", label, r->pc, r->opcode);
+    for (int i = 0; i < 16; i++) {
+        if (r->reg_mask & (1 << i)) {
+            printf(" V%X=0x%02X", i, r->V[i]);
+        }
+    }
+    if (r->mem_len > 0) {
+        printf(" mem[0x%03X]=", r->mem_addr);
+        for (int i = 0; i < r->mem_len; i++) {
+            printf("%02X", r->mem[i]);
+        }
+    }
+    printf("\n");
+}
+
+static bool records_equal(const TRACE_RECORD *a, const TRACE_RECORD *b) {
+    if (a->pc != b->pc || a->opcode != b->opcode || a->reg_mask != b->reg_mask ||
+        a->mem_addr != b->mem_addr || a->mem_len != b->mem_len) {
+        return false;
+    }
+    for (int i = 0; i < 16; i++) {
+        if ((a->reg_mask & (1 << i)) && a->V[i] != b->V[i]) {
+            return false;
+        }
+    }
+    return memcmp(a->mem, b->mem, a->mem_len) == 0;
+}
+
+static int trace_diff(const char *path_a, const char *path_b) {
+    FILE *a = open_trace(path_a);
+    FILE *b = open_trace(path_b);
+    if (a == NULL || b == NULL) {
+        if (a != NULL) {
+            fclose(a);
+        }
+        if (b != NULL) {
+            fclose(b);
+        }
+        return 2;
+    }
+
+    // Each decoder keeps its own delta state
+    TRACE_STATE *state_a = calloc(1, sizeof(TRACE_STATE));
+    TRACE_STATE *state_b = calloc(1, sizeof(TRACE_STATE));
+    TRACE_RECORD rec_a, rec_b;
+    uint64_t index = 0;
+    int result = 0;
+
+    while (1) {
+        TRACE_READ_RESULT read_a = chip8_trace_read(a, state_a, &rec_a);
+        TRACE_READ_RESULT read_b = chip8_trace_read(b, state_b, &rec_b);
+        // A cut off record means the file is damaged, don't report it as a shorter run
+        if (read_a == TRACE_READ_TRUNCATED || read_b == TRACE_READ_TRUNCATED) {
+            printf("%s is truncated at instruction %lu\n", read_a == TRACE_READ_TRUNCATED ? path_a : path_b,
+                   (unsigned long)index);
+            result = 2;
+            break;
+        }
+        if (read_a == TRACE_READ_END && read_b == TRACE_READ_END) {
+            printf("Traces match (%lu instructions)\n", (unsigned long)index);
+            break;
+        }
+        if (read_a != read_b) {
+            printf("Traces diverge at instruction %lu: %s ends first\n", (unsigned long)index,
+                   read_a == TRACE_READ_END ? path_a : path_b);
+            result = 1;
+            break;
+        }
+        if (!records_equal(&rec_a, &rec_b)) {
+            printf("Traces diverge at instruction %lu\n", (unsigned long)index);
+            print_record(path_a, &rec_a);
+            print_record(path_b, &rec_b);
+            result = 1;
+            break;
+        }
+        index++;
+    }
+
+    free(state_a);
+    free(state_b);
+    fclose(a);
+    fclose(b);
+    return result;
+}
+
+// Collapse operands so the histogram counts instructions, not individual opcodes
+// ex: 6A02 -> 6000, 8124 -> 8004, F233 -> F033
+static uint16_t opcode_class(uint16_t opcode) {
+    switch (opcode >> 12) {
+        case 0:
+            return (opcode == 0x00E0 || opcode == 0x00EE) ? opcode : 0;
+        case 8:
+            return opcode & 0xF00F;
+        case 0xE:
+        case 0xF:
+            return opcode & 0xF0FF;
+        default:
+            return opcode & 0xF000;
+    }
+}
+
+static const char *opcode_name(uint16_t opcode_class) {
+    switch (opcode_class >> 12) {
+        case 0:
+            if (opcode_class == 0x00E0) return "00E0 (clear)";
+            if (opcode_class == 0x00EE) return "00EE (return)";
+            return "0NNN";
+        case 1: return "1NNN (jump)";
+        case 2: return "2NNN (call)";
+        case 3: return "3XNN (skip ==)";
+        case 4: return "4XNN (skip !=)";
+        case 5: return "5XY0 (skip VX == VY)";
+        case 6: return "6XNN (set)";
+        case 7: return "7XNN (add)";
+        case 9: return "9XY0 (skip VX != VY)";
+        case 0xA: return "ANNN (set I)";
+        case 0xB: return "BNNN (jump + V0)";
+        case 0xC: return "CXNN (random)";
+        case 0xD: return "DXYN (draw)";
+        default: return NULL;
+    }
+}
+
+static int trace_hist(const char *path) {
+    FILE *f = open_trace(path);
+    if (f == NULL) {
+        return 2;
+    }
+
+    TRACE_STATE *state = calloc(1, sizeof(TRACE_STATE));
+    uint64_t *counts = calloc(0x10000, sizeof(uint64_t));
+    TRACE_RECORD record;
+    uint64_t total = 0;
+
+    TRACE_READ_RESULT read;
+    while ((read = chip8_trace_read(f, state, &record)) == TRACE_READ_OK) {
+        counts[opcode_class(record.opcode)]++;
+        total++;
+    }
+
+    printf("%lu instructions\n", (unsigned long)total);
+    if (read == TRACE_READ_TRUNCATED) {
+        printf("Warning: %s is truncated after instruction %lu\n", path, (unsigned long)total);
+    }
+    // Print the most frequent instruction first
+    while (1) {
+        uint32_t best = 0;
+        for (uint32_t op = 1; op < 0x10000; op++) {
+            if (counts[op] > counts[best]) {
+                best = op;
+            }
+        }
+        if (counts[best] == 0) {
+            break;
+        }
+        const char *name = opcode_name(best);
+        char generic[16];
+        if (name == NULL) {
+            // 8XYN / EXNN / FXNN -- show the sub operation
+            if ((best >> 12) == 8) {
+                snprintf(generic, sizeof(generic), "8XY%X", best & 0xF);
+            } else {
+                snprintf(generic, sizeof(generic), "%XX%02X", best >> 12, best & 0xFF);
+            }
+            name = generic;
+        }
+        printf("%-22s %12lu  %6.2f%%\n", name, (unsigned long)counts[best], 100.0 * counts[best] / total);
+        counts[best] = 0;
+    }
+
+    free(counts);
+    free(state);
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && strcmp(argv[1], "diff") == 0) {
+        return trace_diff(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "hist") == 0) {
+        return trace_hist(argv[2]);
+    }
+    printf("Usage: %s diff <a.trace> <b.trace>\n"
+           "       %s hist <a.trace>\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,110 @@
+#include "../include/opcode.h"
+
+OPCODE_CLASS chip8_decode(uint16_t opcode) {
+    uint8_t register_num = (opcode >> 8) & 0x0F;
+    uint8_t immediate_value = opcode & 0x00FF;
+
+    switch (opcode >> 12) {
+        case 0:
+            if (opcode == 0x00E0) {
+                return OP_CLEAR;
+            }
+            return opcode == 0x00EE ? OP_RETURN : OP_NONE;
+        case 1: return OP_JUMP;
+        case 2: return OP_CALL;
+        case 3: return OP_SKIP_EQ;
+        case 4: return OP_SKIP_NE;
+        case 5: return OP_SKIP_EQ_REG;
+        case 6: return OP_SET;
+        case 7: return OP_ADD;
+        case 8:
+            switch (opcode & 0x000F) {
+                case 0x0: return OP_MOVE;
+                case 0x1: return OP_OR;
+                case 0x2: return OP_AND;
+                case 0x3: return OP_XOR;
+                case 0x4: return OP_ADD_REG;
+                case 0x5: return OP_SUB;
+                case 0x6: return OP_SHR;
+                case 0x7: return OP_SUBN;
+                case 0xE: return OP_SHL;
+            }
+            return OP_NONE;
+        case 9: return OP_SKIP_NE_REG;
+        case 0xA: return OP_SET_I;
+        case 0xB: return OP_JUMP_V0;
+        case 0xC: return OP_RANDOM;
+        case 0xD: return OP_DRAW;
+        case 0xE:
+            // The key checks run for any X, then fall into the 0xF case where nothing matches
+            if (immediate_value == 0x9E) {
+                return OP_SKIP_KEY;
+            }
+            if (immediate_value == 0xA1) {
+                return OP_SKIP_NO_KEY;
+            }
+            // fall through
+        case 0xF:
+            if (register_num == 0) {
+                return OP_SYSCALL;
+            }
+            switch (immediate_value) {
+                case 0x07: return OP_GET_DELAY;
+                case 0x0A: return OP_WAIT_KEY;
+                case 15: return OP_SET_DELAY;
+                case 18: return OP_SET_SOUND;
+                case 0x1E: return OP_ADD_I;
+                case 0x29: return OP_FONT;
+                case 0x33: return OP_BCD;
+                case 0x55: return OP_STORE;
+                case 0x65: return OP_LOAD;
+            }
+            return OP_NONE;
+    }
+    return OP_NONE;
+}
+
+uint16_t chip8_registers_written(uint16_t opcode) {
+    uint16_t register_num = (opcode >> 8) & 0x0F;
+    uint16_t VX = 1 << register_num;
+    uint16_t VF = 1 << 0xF;
+
+    switch (chip8_decode(opcode)) {
+        case OP_SET:
+        case OP_ADD:
+        case OP_MOVE:
+        case OP_OR:
+        case OP_AND:
+        case OP_XOR:
+        case OP_RANDOM:
+        case OP_GET_DELAY:
+        case OP_WAIT_KEY:
+            return VX;
+        case OP_ADD_REG:
+        case OP_SUB:
+        case OP_SHR:
+        case OP_SUBN:
+        case OP_SHL:
+            return VX | VF;
+        case OP_DRAW:
+            return VF;
+        case OP_LOAD:
+            return (VX << 1) - 1;
+        // Syscall 0 is the bootloader, which clears every register
+        case OP_SYSCALL:
+            return (opcode & 0x00FF) == 0 ? 0xFFFF : 0;
+        default:
+            return 0;
+    }
+}
+
+uint8_t chip8_memory_written(uint16_t opcode) {
+    switch (chip8_decode(opcode)) {
+        case OP_BCD:
+            return 3;
+        case OP_STORE:
+            return ((opcode >> 8) & 0x0F) + 1;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "../include/trace.h"
+#include "../include/opcode.h"
+
+// 8 chunks of 64KB -- the CPU fills one chunk while the writer thread flushes the others
+#define TRACE_CHUNKS 8
+#define TRACE_CHUNK_SIZE 65536
+// Worst case record: flags + pc + opcode + register mask and values + memory write
+#define TRACE_RECORD_MAX 64
+
+typedef struct {
+    uint8_t data[TRACE_CHUNK_SIZE];
+    size_t len;
+} TRACE_CHUNK;
+
+struct TRACE {
+    FILE *f;
+    pthread_t writer;
+
+    // Single producer (CPU thread) / single consumer (writer thread) ring
+    // head = chunks handed to the writer, tail = chunks written to disk
+    TRACE_CHUNK *chunks;
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    atomic_bool stop;
+
+    // Write cursor into the chunk the CPU thread is filling
+    uint8_t *out;
+    uint8_t *out_end;
+
+    TRACE_STATE state;
+    // What the opcode cached in state.opcodes[slot] writes, worked out once per cache miss
+    // so chip8_cycle doesn't have to snapshot V around every instruction
+    uint16_t writes[TRACE_PC_SLOTS];
+    uint8_t stores[TRACE_PC_SLOTS];
+    uint64_t count;
+};
+
+_Thread_local TRACE *chip8_active_trace = NULL;
+
+static void *trace_writer(void *arg) {
+    TRACE *trace = arg;
+    struct timespec nap = {0, 500000};
+
+    while (1) {
+        // Read stop before head so the final chunk published by close is never missed
+        bool stopping = atomic_load(&trace->stop);
+        uint32_t head = atomic_load_explicit(&trace->head, memory_order_acquire);
+        uint32_t tail = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+
+        if (tail != head) {
+            TRACE_CHUNK *chunk = &trace->chunks[tail % TRACE_CHUNKS];
+            fwrite(chunk->data, 1, chunk->len, trace->f);
+            atomic_store_explicit(&trace->tail, tail + 1, memory_order_release);
+        } else if (stopping) {
+            break;
+        } else {
+            nanosleep(&nap, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Hand the current chunk to the writer and move on to the next free one
+static void trace_publish(TRACE *trace) {
+    uint32_t head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    TRACE_CHUNK *chunk = &trace->chunks[head % TRACE_CHUNKS];
+    chunk->len = trace->out - chunk->data;
+    atomic_store_explicit(&trace->head, head + 1, memory_order_release);
+
+    // Ring is full, wait for the writer to catch up
+    while (head + 1 - atomic_load_explicit(&trace->tail, memory_order_acquire) >= TRACE_CHUNKS) {
+        sched_yield();
+    }
+
+    chunk = &trace->chunks[(head + 1) % TRACE_CHUNKS];
+    trace->out = chunk->data;
+    trace->out_end = chunk->data + TRACE_CHUNK_SIZE - TRACE_RECORD_MAX;
+}
+
+TRACE *chip8_trace_open(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        printf("Failed to open trace file %s\n", path);
+        return NULL;
+    }
+
+    TRACE *trace = calloc(1, sizeof(TRACE));
+    trace->chunks = malloc(sizeof(TRACE_CHUNK) * TRACE_CHUNKS);
+    if (trace->chunks == NULL) {
+        printf("Failed to allocate trace buffer\n");
+        free(trace);
+        fclose(f);
+        return NULL;
+    }
+    trace->f = f;
+    trace->out = trace->chunks[0].data;
+    trace->out_end = trace->chunks[0].data + TRACE_CHUNK_SIZE - TRACE_RECORD_MAX;
+
+    fwrite(TRACE_MAGIC, 1, 4, f);
+    fputc(TRACE_VERSION, f);
+
+    pthread_create(&trace->writer, NULL, trace_writer, trace);
+    return trace;
+}
+
+void chip8_trace_close(TRACE *trace) {
+    if (trace == NULL) {
+        return;
+    }
+    trace_publish(trace);
+    atomic_store(&trace->stop, true);
+    pthread_join(trace->writer, NULL);
+
+    fclose(trace->f);
+    free(trace->chunks);
+    free(trace);
+}
+
+uint64_t chip8_trace_count(const TRACE *trace) {
+    return trace->count;
+}
+
+static uint8_t *put_varint(uint8_t *out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    return out;
+}
+
+// Called at the end of chip8_cycle with the pc and registers after the instruction
+void chip8_trace_step(TRACE *trace, uint16_t pc, uint16_t pc_after, uint16_t opcode, uint16_t I_before,
+                      const uint8_t V[16], const uint8_t *memory) {
+    TRACE_STATE *state = &trace->state;
+    // Build the flags in a local and store them last, byte stores into the buffer may alias anything
+    uint8_t *record = trace->out;
+    uint8_t *out = record + 1;
+    uint8_t flags = 0;
+
+    uint16_t next_pc = state->next_pc;
+    state->next_pc = pc + 2;
+    if (pc != next_pc) {
+        int32_t delta = (int32_t)pc - (int32_t)next_pc;
+        flags |= TRACE_F_PC;
+        out = put_varint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+    }
+
+    uint16_t slot = pc < TRACE_PC_SLOTS ? pc : pc % TRACE_PC_SLOTS;
+    if (state->opcodes[slot] != opcode) {
+        state->opcodes[slot] = opcode;
+        trace->writes[slot] = chip8_registers_written(opcode);
+        trace->stores[slot] = chip8_memory_written(opcode);
+        flags |= TRACE_F_OPCODE;
+        out[0] = opcode >> 8;
+        out[1] = opcode & 0xFF;
+        out += 2;
+    }
+
+    // FX0A waiting for a key repeats itself without writing VX, no other register write leaves pc in place
+    uint16_t mask = pc_after != pc ? trace->writes[slot] : 0;
+    if (mask != 0 && (mask & (mask - 1)) == 0) {
+        int reg = __builtin_ctz(mask);
+        flags |= TRACE_F_REG | (reg << 4);
+        *out++ = V[reg];
+    } else if (mask != 0) {
+        flags |= TRACE_F_REG_MULTI;
+        *out++ = mask >> 8;
+        *out++ = mask & 0xFF;
+        for (int i = 0; i < 16; i++) {
+            if (mask & (1 << i)) {
+                *out++ = V[i];
+            }
+        }
+    }
+
+    uint8_t len = trace->stores[slot];
+    if (len > 0 && I_before + len <= TRACE_PC_SLOTS) {
+        flags |= TRACE_F_MEM;
+        out = put_varint(out, I_before);
+        *out++ = len;
+        memcpy(out, &memory[I_before], len);
+        out += len;
+    }
+
+    *record = flags;
+    trace->out = out;
+    trace->count++;
+    if (out >= trace->out_end) {
+        trace_publish(trace);
+    }
+}
+
+bool chip8_trace_read_header(FILE *f) {
+    char magic[4];
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0) {
+        return false;
+    }
+    return fgetc(f) == TRACE_VERSION;
+}
+
+static bool get_varint(FILE *f, uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) {
+            return false;
+        }
+        *value |= (uint32_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_bytes(FILE *f, uint8_t *dst, size_t len) {
+    return fread(dst, 1, len, f) == len;
+}
+
+// Decode the next record
+TRACE_READ_RESULT chip8_trace_read(FILE *f, TRACE_STATE *state, TRACE_RECORD *record) {
+    int flags = fgetc(f);
+    if (flags == EOF) {
+        return TRACE_READ_END;
+    }
+    memset(record, 0, sizeof(*record));
+
+    record->pc = state->next_pc;
+    if (flags & TRACE_F_PC) {
+        uint32_t zigzag;
+        if (!get_varint(f, &zigzag)) {
+            return TRACE_READ_TRUNCATED;
+        }
+        int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        record->pc = state->next_pc + delta;
+    }
+    state->next_pc = record->pc + 2;
+
+    uint16_t slot = record->pc % TRACE_PC_SLOTS;
+    if (flags & TRACE_F_OPCODE) {
+        uint8_t op[2];
+        if (!get_bytes(f, op, 2)) {
+            return TRACE_READ_TRUNCATED;
+        }
+        state->opcodes[slot] = (op[0] << 8) | op[1];
+    }
+    record->opcode = state->opcodes[slot];
+
+    if (flags & TRACE_F_REG) {
+        uint8_t reg = flags >> 4;
+        record->reg_mask = 1 << reg;
+        if (!get_bytes(f, &record->V[reg], 1)) {
+            return TRACE_READ_TRUNCATED;
+        }
+    } else if (flags & TRACE_F_REG_MULTI) {
+        uint8_t mask[2];
+        if (!get_bytes(f, mask, 2)) {
+            return TRACE_READ_TRUNCATED;
+        }
+        record->reg_mask = (mask[0] << 8) | mask[1];
+        for (int i = 0; i < 16; i++) {
+            if ((record->reg_mask & (1 << i)) && !get_bytes(f, &record->V[i], 1)) {
+                return TRACE_READ_TRUNCATED;
+            }
+        }
+    }
+
+    if (flags & TRACE_F_MEM) {
+        uint32_t addr;
+        uint8_t len;
+        if (!get_varint(f, &addr) || !get_bytes(f, &len, 1) || len > sizeof(record->mem)) {
+            return TRACE_READ_TRUNCATED;
+        }
+        record->mem_addr = addr;
+        record->mem_len = len;
+        if (!get_bytes(f, record->mem, len)) {
+            return TRACE_READ_TRUNCATED;
+        }
+    }
+    return TRACE_READ_OK;
+}
@@ -43,10 +43,28 @@ void chip8_init(CPU *cpu) {
         cpu->memory[0x50 + i] = chip8_fontset[i];
     }
 
+    chip8_seed(cpu, 1);
+
     printf("CHIP-8 initialized\n");
     cpu->mode = USER_MODE;
 }
 
+// Pick where the instance's CXNN sequence starts
+void chip8_seed(CPU *cpu, uint32_t seed) {
+    // xorshift would stay at 0 forever
+    cpu->rng = seed != 0 ? seed : 1;
+}
+
+// Next random byte for CXNN (xorshift32, top byte)
+static uint8_t chip8_random(CPU *cpu) {
+    uint32_t x = cpu->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cpu->rng = x;
+    return x >> 24;
+}
+
 void chip8_load_disk(CHIP8_SYSTEM *chip) {
     DiskFile *breakout = &chip->io.disk.files[0];
     DiskFile *tetris = &chip->io.disk.files[1];
@@ -130,6 +148,14 @@ void chip8_load_rom(CHIP8_SYSTEM *chip, const char *filename) {
     VirtualDisk *disk = &chip->io.disk;
     for (int i = 0; i < disk->file_count; i++) {
         if (strcmp(chip->io.disk.files[i].name, filename) == 0) {
+            // Disassemble the ROM before it goes into memory and report what it will run
+            static ROM_ANALYSIS info;
+            chip8_analyze_rom(&info, (const uint8_t *)chip->io.disk.files[i].data, chip->io.disk.files[i].size);
+            printf("%s: %u instructions in %u blocks, %u sprite bytes\n", filename,
+                   info.instruction_count, info.block_count, info.sprite_bytes);
+            if (info.unknown_count > 0) {
+                printf("Warning: %u unknown opcodes, first at 0x%03X\n", info.unknown_count, info.unknown[0]);
+            }
             memcpy(&chip->cpu.memory[0x200], chip->io.disk.files[i].data, chip->io.disk.files[i].size);
             break;
         }
@@ -208,9 +234,16 @@ void chip8_handle_rom(CHIP8_SYSTEM *chip, SDL_Renderer *renderer) {
 }
 
 // Fetch 2, 2-byte code instructions (1 byte == 8 bits, 2 bytes == 16), combines into 16 bit format
+// chip8_decode (opcode.c) mirrors the decoding below for the tracer, analyzer and batch engine -- keep them in step
 void chip8_cycle(CPU *chip, IO *io) {
     uint16_t opcode = (chip->memory[chip->pc] << 8) | chip->memory[chip->pc + 1];
     bool kernel_opcode = (opcode & 0x0F00) == 0;
+
+    // State the tracer needs from before the instruction (only when tracing is on)
+    TRACE *tracer = chip8_active_trace;
+    uint16_t trace_pc = chip->pc;
+    uint16_t trace_I = chip->I;
+
     chip->pc += 2;
     
     // Break opcode into nibbles (4 bits = 1 nibble) ex: [6][A][0][2]
@@ -350,7 +383,7 @@ void chip8_cycle(CPU *chip, IO *io) {
             break;
         // Random (CXNN) - Set VX to a random byte AND NN -- 0-255 & NN
         case 0xC:
-            chip->V[register_num] = rand() & immediate_value;
+            chip->V[register_num] = chip8_random(chip) & immediate_value;
             break;
         // Draw sprite (DXYN) - Draw an N byte sprite at coords VX, VY
         case 0xD:
@@ -539,6 +572,10 @@ void chip8_cycle(CPU *chip, IO *io) {
                 break;
             }
     }
+
+    if (tracer) {
+        chip8_trace_step(tracer, trace_pc, chip->pc, opcode, trace_I, chip->V, chip->memory);
+    }
 }
 
 void chip8_tick_timers(IO *io) {